@@ -7,7 +7,8 @@
 
 using namespace ILS;
 
-static int32_t scanNeighborhood(Problem::Solution &Solution, long int &Budget);
+static int32_t scanNeighborhood(Problem::Solution &Solution, long int &Budget,
+                                std::chrono::steady_clock::time_point Deadline);
 // static bool canSwap(const Problem::Instance &, const std::vector<size_t> &,
 //                    size_t I, size_t J, float);
 
@@ -20,15 +21,19 @@ Problem::Solution ILS::solveInstance(const Problem::Instance &Instance,
     auto NumIt                   = 0;
     std::vector<size_t> Schedule = Problem::constructSchedule(Instance);
     Problem::Solution CurrentSolution(Instance, Schedule);
-    applyLocalSearch(CurrentSolution, Budget);
+    applyLocalSearch(CurrentSolution, Budget, Config.Deadline);
 
     auto CurrentMakespan = CurrentSolution.GetMakespan();
 
-    while (Budget > 0) {
+    // A single task has no neighbours, the budget would never be spent
+    if (CurrentSolution.Size() < 2)
+        return CurrentSolution;
+
+    while (Budget > 0 && std::chrono::steady_clock::now() < Config.Deadline) {
         auto CandidateSolution = CurrentSolution;
         applyPerturbation(CandidateSolution, Config.PerturbationStrength,
                           RandomGenerator);
-        applyLocalSearch(CandidateSolution, Budget);
+        applyLocalSearch(CandidateSolution, Budget, Config.Deadline);
         // Evaluates the schedule with perturbation
         auto CandidateMakespan = CandidateSolution.GetMakespan();
 
@@ -47,8 +52,10 @@ Problem::Solution ILS::solveInstance(const Problem::Instance &Instance,
 void ILS::applyPerturbation(Problem::Solution &Solution,
                             float PerturbationStrength,
                             std::default_random_engine &RandomGenerator) {
-    auto Size       = Solution.Size();
-    auto NumOfSwaps = Size * PerturbationStrength / 2;
+    auto Size = Solution.Size();
+    // Counted as an integer so an oversized strength can't stall the loop
+    size_t NumOfSwaps =
+        Size * std::min(std::max(PerturbationStrength, 0.0f), 1.0f) / 2;
     std::uniform_int_distribution<size_t> Distribution(0, Size - 1);
 
     while (NumOfSwaps-- > 0) {
@@ -58,7 +65,8 @@ void ILS::applyPerturbation(Problem::Solution &Solution,
     }
 }
 
-static int32_t scanNeighborhood(Problem::Solution &Solution, long int &Budget) {
+static int32_t scanNeighborhood(Problem::Solution &Solution, long int &Budget,
+                                std::chrono::steady_clock::time_point Deadline) {
     auto Size            = Solution.Size();
     auto CurrentMakespan = Solution.GetMakespan();
 
@@ -66,6 +74,11 @@ static int32_t scanNeighborhood(Problem::Solution &Solution, long int &Budget) {
         for (size_t J = I + 1; J < Size; ++J) {
             if (Budget <= 0)
                 return -1;
+            // Out of time: drop the remaining budget so every loop stops
+            if (std::chrono::steady_clock::now() >= Deadline) {
+                Budget = 0;
+                return -1;
+            }
 
             Solution.SwapTasks(I, J);
             --Budget;
@@ -79,8 +92,9 @@ static int32_t scanNeighborhood(Problem::Solution &Solution, long int &Budget) {
     return -1;
 }
 
-void ILS::applyLocalSearch(Problem::Solution &Solution, long int &Budget) {
-    while (Budget > 0 && scanNeighborhood(Solution, Budget) > 0) {
+void ILS::applyLocalSearch(Problem::Solution &Solution, long int &Budget,
+                           std::chrono::steady_clock::time_point Deadline) {
+    while (Budget > 0 && scanNeighborhood(Solution, Budget, Deadline) > 0) {
         continue;
     }
 }
@@ -1,6 +1,7 @@
 #ifndef ILS_H
 #define ILS_H
 
+#include <chrono>
 #include <random>
 
 #include "problem.h"
@@ -13,6 +14,9 @@ struct Config {
     float PerturbationStrength;
     long int Evaluations;
     int RandomSeed;
+    // Wall-clock point after which the search stops, whatever budget is left
+    std::chrono::steady_clock::time_point Deadline =
+        std::chrono::steady_clock::time_point::max();
 };
 
 /// Solves a problem's instance.
@@ -47,9 +51,11 @@ void applyPerturbation(Problem::Solution &Solution, float PerturbationStrength,
 /// \endcode
 ///
 /// \param Solution solution to apply local search to.
-/// \param TLE time limit exceeded flag.
-///        Should be handled by another thread.
-void applyLocalSearch(Problem::Solution &Solution, long int &Evaluations);
+/// \param Evaluations remaining evaluation budget, decremented in place.
+/// \param Deadline time limit. Once reached, the budget is set to 0.
+void applyLocalSearch(Problem::Solution &Solution, long int &Evaluations,
+                      std::chrono::steady_clock::time_point Deadline =
+                          std::chrono::steady_clock::time_point::max());
 
 } // namespace ILS
 #endif
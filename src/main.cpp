@@ -1,7 +1,14 @@
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
 #include <string>
 
+#include <unistd.h>
+
 #include "ils.h"
 #include "problem.h"
+#include "service.h"
 
 std::string InstancePath;
 long int Evaluations       = -1;
@@ -9,11 +16,29 @@ float PerturbationStrength = 0.5;
 float RelaxationThreshold  = 0;
 int RandomSeed             = 0;
 bool SetupTimes            = true;
+bool Serve                 = false;
+std::string SocketPath;
+std::string ConnectPath;
+size_t Workers   = 0;
+size_t CacheSize = 8;
+
+// Parses a whole non-negative integer, rejecting anything else
+static bool parseCount(const char *Text, size_t &Count) {
+    char *End;
+    errno      = 0;
+    long Value = strtol(Text, &End, 10);
+    if (End == Text || *End != '\0' || errno == ERANGE || Value < 0)
+        return false;
+    Count = Value;
+    return true;
+}
 
 int parseCommandLine(int Argc, char *Argv[]) {
     const auto HELP_MSG =
         " Iterated Local Search implementation for the [untitled] problem\n\n"
-        " USAGE:\n\n  ./ils [OPTIONS] INSTANCE_PATH\n\n"
+        " USAGE:\n\n  ./ils [OPTIONS] INSTANCE_PATH\n"
+        "  ./ils --serve [--socket PATH] [OPTIONS]\n"
+        "  ./ils --connect PATH\n\n"
         " OPTIONS:\n\n"
         " -h, --help\n"
         " \tShow this message and exit\n\n"
@@ -27,7 +52,20 @@ int parseCommandLine(int Argc, char *Argv[]) {
         " --relaxation [THRESHOLD]\n"
         " \tThreshold for relaxation of priority rules, in range [0, 1]\n\n"
         " --seed [SEED]\n"
-        " \tSeed for random number generator\n\n";
+        " \tSeed for random number generator\n\n"
+        " SERVICE OPTIONS:\n\n"
+        " --serve\n"
+        " \tRead JSON-lines jobs from stdin and write one result per line\n"
+        " \tto stdout. The options above are the defaults for every job\n\n"
+        " --socket [PATH]\n"
+        " \tServe jobs on a Unix domain socket instead of stdin\n\n"
+        " --workers [N]\n"
+        " \tNumber of jobs solved concurrently.\n"
+        " \tdefault is 0 (one per hardware thread)\n\n"
+        " --cache-size [N]\n"
+        " \tNumber of loaded instances kept in memory (default is 8)\n\n"
+        " --connect [PATH]\n"
+        " \tSend jobs from stdin to the server at PATH, print the results\n\n";
 
     if (Argc < 2) {
         std::cout << HELP_MSG;
@@ -79,12 +117,61 @@ int parseCommandLine(int Argc, char *Argv[]) {
         else if ((Arg == "--no-setup-times"))
             SetupTimes = false;
 
+        else if ((Arg == "--serve"))
+            Serve = true;
+
+        else if ((Arg == "--socket"))
+            if (I + 1 < Argc) {
+                SocketPath = Argv[++I];
+                Serve      = true;
+            }
+            else {
+                std::cout << "--socket option requires one argument\n";
+                return -1;
+            }
+
+        else if ((Arg == "--workers"))
+            if (I + 1 < Argc && parseCount(Argv[I + 1], Workers))
+                ++I;
+            else {
+                std::cout << "--workers option requires a non-negative "
+                             "integer\n";
+                return -1;
+            }
+
+        else if ((Arg == "--cache-size"))
+            if (I + 1 < Argc && parseCount(Argv[I + 1], CacheSize))
+                ++I;
+            else {
+                std::cout << "--cache-size option requires a non-negative "
+                             "integer\n";
+                return -1;
+            }
+
+        else if ((Arg == "--connect"))
+            if (I + 1 < Argc)
+                ConnectPath = Argv[++I];
+            else {
+                std::cout << "--connect option requires one argument\n";
+                return -1;
+            }
+
         // TODO: add a --silent mode
 
         else
             InstancePath = Arg;
     }
 
+    // Out of range values trip the solver's assertions
+    if (RelaxationThreshold < 0 || RelaxationThreshold > 1) {
+        std::cout << "--relaxation must be in range [0, 1]\n";
+        return -1;
+    }
+    if (PerturbationStrength < 0 || PerturbationStrength > 1) {
+        std::cout << "--perturbation must be in range [0, 1]\n";
+        return -1;
+    }
+
     return 0;
 }
 
@@ -98,9 +185,30 @@ int main(int Argc, char *Argv[]) {
     //          << PerturbationStrength << " -p " << RelaxationThreshold
     //          << " --seed " << RandomSeed << "\n";
 
+    if (!ConnectPath.empty())
+        return Service::runClient(ConnectPath);
+
     Problem::Config ProblemConfig = {RelaxationThreshold, SetupTimes};
-    Problem::Instance Instance =
-        Problem::loadInstance(InstancePath, ProblemConfig);
+
+    if (Serve) {
+        Service::Config ServiceConfig = {ProblemConfig, PerturbationStrength,
+                                         Evaluations,   RandomSeed,
+                                         Workers,       CacheSize};
+        if (!SocketPath.empty())
+            return Service::serveSocket(SocketPath, ServiceConfig);
+        return Service::serveStream(STDIN_FILENO, STDOUT_FILENO,
+                                    ServiceConfig);
+    }
+
+    std::unique_ptr<Problem::Instance> Loaded;
+    try {
+        Loaded.reset(new Problem::Instance(
+            Problem::loadInstance(InstancePath, ProblemConfig)));
+    } catch (const std::runtime_error &E) {
+        std::cerr << "error: " << E.what() << "\n";
+        return -1;
+    }
+    const Problem::Instance &Instance = *Loaded;
 
     // Automatically calculates the amount of evaluation calls
     // based on the number of nodes
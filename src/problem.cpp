@@ -1,4 +1,5 @@
 #include <fstream>
+#include <stdexcept>
 
 #include "problem.h"
 
@@ -15,41 +16,83 @@ Problem::Instance Problem::loadInstance(std::string InstancePath,
     std::ifstream InstanceFile(InstancePath);
     size_t NumOfNodes, NumOfEdges;
 
-    if (InstanceFile.is_open()) {
-        // Read the set of nodes
-        size_t Id;
-        int Type, Duration, NumberOfWT;
-        float Risk;
-        InstanceFile >> NumOfNodes;
-        for (size_t I = 0; I < NumOfNodes; ++I) {
-            InstanceFile >> Id >> Type >> Duration >> NumberOfWT >> Risk;
-            Nodes.push_back({Id, (NodeType)Type, (uint32_t)Duration,
-                             (uint32_t)NumberOfWT, Risk});
-
-            assert(Id == Nodes[Id].Id && "Node Id must match the index!");
-            assert((Type == Origin || Type == Destination) &&
-                   "Wrong Type for node!");
-            assert(Duration >= 0 && "Duration is negative!");
-            assert(NumberOfWT >= 0 && "NumOfWT is negative!");
-            assert((0 <= Risk && Risk <= 1) && "Risk is out of range [0, 1]!");
-        }
+    auto fail = [&](const std::string &Reason) {
+        throw std::runtime_error("invalid instance " + InstancePath + ": " +
+                                 Reason);
+    };
+
+    if (!InstanceFile.is_open())
+        throw std::runtime_error("unable to open path " + InstancePath);
+
+    // Read the set of nodes
+    size_t Id;
+    int Type, Duration, NumberOfWT;
+    float Risk;
+    size_t NumOfDestinations = 0, TotalNumOfWT = 0;
+    if (!(InstanceFile >> NumOfNodes))
+        fail("missing number of nodes");
+    for (size_t I = 0; I < NumOfNodes; ++I) {
+        if (!(InstanceFile >> Id >> Type >> Duration >> NumberOfWT >> Risk))
+            fail("expected " + std::to_string(NumOfNodes) + " nodes, read " +
+                 std::to_string(I));
+        if (Id != I)
+            fail("node id " + std::to_string(Id) + " must match its index " +
+                 std::to_string(I));
+        if (Type != Origin && Type != Destination)
+            fail("wrong type for node " + std::to_string(Id));
+        if (Duration < 0 || NumberOfWT < 0)
+            fail("negative duration or number of WT for node " +
+                 std::to_string(Id));
+        // Without setup times such a task could finish at time 0, which
+        // the makespan evaluation treats as never scheduled
+        if (Type == Destination && Duration == 0 && !Config.SetupTimes)
+            fail("destination " + std::to_string(Id) +
+                 " has no duration and setup times are disabled");
+        if (!(0 <= Risk && Risk <= 1))
+            fail("risk of node " + std::to_string(Id) +
+                 " is out of range [0, 1]");
+
+        Nodes.push_back({Id, (NodeType)Type, (uint32_t)Duration,
+                         (uint32_t)NumberOfWT, Risk});
+        NumOfDestinations += (Type == Destination);
+        TotalNumOfWT += (Type == Origin ? NumberOfWT : 0);
+    }
+    // The solver needs something to schedule and someone to do it
+    if (NumOfDestinations == 0)
+        fail("no destination nodes");
+    if (TotalNumOfWT == 0)
+        fail("no work teams at the origins");
+
+    // Read the set of edges
+    uint32_t DefaultWeight = (Config.SetupTimes ? 1 : 0);
+    size_t IdU, IdV;
+    if (!(InstanceFile >> NumOfEdges))
+        fail("missing number of edges");
+    for (size_t I = 0; I < NumOfEdges; ++I) {
+        if (!(InstanceFile >> IdU >> IdV))
+            fail("expected " + std::to_string(NumOfEdges) + " edges, read " +
+                 std::to_string(I));
+        if (IdU >= NumOfNodes || IdV >= NumOfNodes)
+            fail("edge " + std::to_string(I) + " has an unknown node");
+        Edges.push_back({Nodes[IdU], Nodes[IdV], DefaultWeight});
+    }
 
-        // Read the set of edges
-        uint32_t DefaultWeight = (Config.SetupTimes ? 1 : 0);
-        size_t IdU, IdV;
-        InstanceFile >> NumOfEdges;
-        for (size_t I = 0; I < NumOfEdges; ++I) {
-            InstanceFile >> IdU >> IdV;
-            Edges.push_back({Nodes[IdU], Nodes[IdV], DefaultWeight});
-        }
+    InstanceFile.close();
+    Instance Loaded(NumOfNodes, NumOfEdges, Nodes, Edges,
+                    Config.RelaxationThreshold);
 
-        InstanceFile.close();
-    } else {
-        std::cerr << "error: unable to open path " << InstancePath << "\n";
-        abort();
+    // Teams travel from origins to destinations and between destinations.
+    // An unreachable destination would overflow the finish times.
+    const auto DestinationsIds = Loaded.GetDestinationsIds();
+    for (const auto &Node : Nodes) {
+        if (Node.isOrigin() && Node.NumberOfWT == 0)
+            continue;
+        for (auto VId : DestinationsIds)
+            if (Loaded.DistMatrix[Node.Id][VId] == (uint32_t)M)
+                fail("destination " + std::to_string(VId) +
+                     " is unreachable from node " + std::to_string(Node.Id));
     }
-    return Instance(NumOfNodes, NumOfEdges, Nodes, Edges,
-                    Config.RelaxationThreshold);
+    return Loaded;
 }
 
 std::vector<size_t> Problem::constructSchedule(Instance Instance) {
@@ -180,9 +223,29 @@ bool Problem::canSwap(const Problem::Instance &Instance,
         }
     }
 
-    return Problem::canRelaxPriority(Nodes[Schedule[HighestRiskIndex]].Risk,
-                                     Nodes[Schedule[J]].Risk,
-                                     Instance.RelaxationThreshold);
+    const auto Threshold = Instance.RelaxationThreshold;
+    const auto RiskI     = Nodes[Schedule[I]].Risk;
+    const auto RiskJ     = Nodes[Schedule[J]].Risk;
+    if (!Problem::canRelaxPriority(Nodes[Schedule[HighestRiskIndex]].Risk,
+                                   RiskJ, Threshold))
+        return false;
+
+    // With a relaxation threshold the schedule isn't sorted anymore, so the
+    // moved nodes must also respect the nodes around them: J's node against
+    // everything before I, and I's node against everything after it.
+    for (size_t K = 0; K < I; ++K)
+        if (!Problem::canRelaxPriority(RiskJ, Nodes[Schedule[K]].Risk,
+                                       Threshold))
+            return false;
+    for (auto K = I + 1; K < J; ++K)
+        if (!Problem::canRelaxPriority(RiskI, Nodes[Schedule[K]].Risk,
+                                       Threshold))
+            return false;
+    for (auto K = J + 1; K < Schedule.size(); ++K)
+        if (!Problem::canRelaxPriority(Nodes[Schedule[K]].Risk, RiskI,
+                                       Threshold))
+            return false;
+    return true;
 }
 
 bool Problem::Solution::IsFeasible() {
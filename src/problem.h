@@ -127,6 +127,7 @@ struct Solution {
 /// \param RelaxationThreshold the value of the relaxation threshold.
 ///
 /// \returns the loaded Problem::Instance.
+/// \throws std::runtime_error if the file can't be opened or is malformed.
 Instance loadInstance(std::string InstancePath, Config Config);
 
 /// Constructs a feasible schedule for an instance.
@@ -0,0 +1,873 @@
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <map>
+#include <system_error>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+#include "ils.h"
+#include "service.h"
+
+using namespace Service;
+
+using Clock = std::chrono::steady_clock;
+
+// Longest job line accepted, anything longer is answered with an error
+static const size_t MaxLineLength = 64 * 1024;
+
+namespace {
+
+// A value of a flat JSON object. Numbers, booleans and null keep their
+// literal text.
+struct Value {
+    bool IsString;
+    std::string Text;
+};
+
+// Results a connection may have queued or running at once. Once it's
+// reached, the connection stops reading jobs until some are written.
+static const size_t MaxJobsInFlight = 16;
+
+// Where the results of a connection go. Results are queued and written by
+// the connection's own thread, so a peer that doesn't read only holds up
+// itself. The fd is closed once the reader and every pending job of the
+// connection are done with it.
+class Channel {
+  public:
+    Channel(int _Fd, bool _OwnsFd) : Fd{_Fd}, OwnsFd{_OwnsFd} {
+        Writer = std::thread([this] { drain(); });
+    }
+    ~Channel() {
+        finish();
+        if (OwnsFd)
+            close(Fd);
+    }
+
+    // Takes a slot for one result, blocking while the connection is full.
+    // Every slot must be given back through send.
+    void acquire() {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        HasRoom.wait(Lock, [this] { return InFlight < MaxJobsInFlight; });
+        ++InFlight;
+    }
+
+    void send(std::string Line) {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Lines.push_back(std::move(Line));
+        }
+        Changed.notify_one();
+    }
+
+    // No more jobs will come. Waits until every result has been written.
+    void finish() {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Finished = true;
+        }
+        Changed.notify_one();
+        if (Writer.joinable())
+            Writer.join();
+    }
+
+  private:
+    int Fd;
+    bool OwnsFd;
+    std::mutex Mutex;
+    std::condition_variable HasRoom, Changed;
+    std::deque<std::string> Lines;
+    size_t InFlight{0};
+    bool Finished{false};
+    std::thread Writer;
+
+    void drain() {
+        bool PeerGone = false;
+        std::unique_lock<std::mutex> Lock(Mutex);
+        for (;;) {
+            Changed.wait(Lock, [this] {
+                return !Lines.empty() || (Finished && InFlight == 0);
+            });
+            if (Lines.empty())
+                return;
+            std::string Line = std::move(Lines.front());
+            Lines.pop_front();
+
+            Lock.unlock();
+            // Once the peer is gone, results are dropped but their slots
+            // still go back
+            if (!PeerGone)
+                PeerGone = !writeAll(Line);
+            Lock.lock();
+
+            --InFlight;
+            HasRoom.notify_one();
+        }
+    }
+
+    bool writeAll(const std::string &Line) {
+        size_t Sent = 0;
+        while (Sent < Line.size()) {
+            auto N = write(Fd, Line.data() + Sent, Line.size() - Sent);
+            if (N < 0 && errno == EINTR)
+                continue;
+            if (N <= 0)
+                return false;
+            Sent += N;
+        }
+        return true;
+    }
+};
+
+struct Job {
+    std::string Id; // Raw JSON, echoed back as is
+    std::string InstancePath;
+    Problem::Config ProblemConfig;
+    float PerturbationStrength;
+    long int Evaluations;
+    int RandomSeed;
+    Clock::time_point Deadline;
+    std::shared_ptr<Channel> Out;
+};
+
+class JobQueue {
+  public:
+    // Returns false, leaving the job to the caller, once the queue is closed
+    bool push(Job &J) {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            if (Closed)
+                return false;
+            Jobs.push_back(std::move(J));
+        }
+        NotEmpty.notify_one();
+        return true;
+    }
+
+    // Blocks until a job is available. Returns false once the queue is
+    // closed and drained.
+    bool pop(Job &J) {
+        std::unique_lock<std::mutex> Lock(Mutex);
+        NotEmpty.wait(Lock, [this] { return Closed || !Jobs.empty(); });
+        if (Jobs.empty())
+            return false;
+        J = std::move(Jobs.front());
+        Jobs.pop_front();
+        return true;
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            Closed = true;
+        }
+        NotEmpty.notify_all();
+    }
+
+  private:
+    std::mutex Mutex;
+    std::condition_variable NotEmpty;
+    std::deque<Job> Jobs;
+    bool Closed{false};
+};
+
+class Server {
+  public:
+    explicit Server(Service::Config _Config)
+        : Config(_Config), Cache(_Config.CacheSize) {}
+
+    // Returns false if the workers can't be created
+    bool start() {
+        try {
+            for (size_t I = 0; I < Config.Workers; ++I)
+                Workers.emplace_back([this] { work(); });
+        } catch (const std::system_error &E) {
+            std::cerr << "error: unable to start " << Config.Workers
+                      << " workers: " << E.what() << "\n";
+            stop();
+            return false;
+        }
+        return true;
+    }
+
+    // Lets the workers finish the queued jobs and waits for them
+    void stop() {
+        Queue.close();
+        for (auto &Worker : Workers)
+            Worker.join();
+        Workers.clear();
+    }
+
+    // Reads jobs until InFd is closed, then waits for their results
+    void serveConnection(int InFd, std::shared_ptr<Channel> Out);
+
+  private:
+    Service::Config Config;
+    InstanceCache Cache;
+    JobQueue Queue;
+    std::vector<std::thread> Workers;
+
+    void work() {
+        Job J;
+        while (Queue.pop(J)) {
+            std::string Result;
+            try {
+                Result = runJob(J);
+            } catch (const std::exception &E) {
+                Result = errorResult(J.Id, E.what());
+            }
+            J.Out->send(Result);
+            J.Out.reset();
+        }
+    }
+
+    void handleLine(const std::string &Line, std::shared_ptr<Channel> Out);
+    std::string runJob(const Job &J);
+    static std::string errorResult(const std::string &Id,
+                                   const std::string &Error);
+};
+
+} // namespace
+
+static std::string quote(const std::string &Text) {
+    std::string Quoted = "\"";
+    for (unsigned char C : Text) {
+        if (C == '"' || C == '\\') {
+            Quoted += '\\';
+            Quoted += C;
+        } else if (C == '\n')
+            Quoted += "\\n";
+        else if (C == '\t')
+            Quoted += "\\t";
+        else if (C < 0x20) {
+            char Escaped[8];
+            snprintf(Escaped, sizeof(Escaped), "\\u%04x", C);
+            Quoted += Escaped;
+        } else
+            Quoted += C;
+    }
+    return Quoted + "\"";
+}
+
+static void skipSpaces(const std::string &Line, size_t &Pos) {
+    while (Pos < Line.size() && isspace((unsigned char)Line[Pos]))
+        ++Pos;
+}
+
+// Reads the four hex digits after the 'u' at Pos, leaving Pos on the last
+static bool parseHex4(const std::string &Line, size_t &Pos,
+                      unsigned long &Code) {
+    if (Pos + 4 >= Line.size())
+        return false;
+    for (size_t I = 1; I <= 4; ++I)
+        if (!isxdigit((unsigned char)Line[Pos + I]))
+            return false;
+    Code = strtoul(Line.substr(Pos + 1, 4).c_str(), nullptr, 16);
+    Pos += 4;
+    return true;
+}
+
+static bool parseString(const std::string &Line, size_t &Pos,
+                        std::string &Text) {
+    if (Pos >= Line.size() || Line[Pos] != '"')
+        return false;
+    for (++Pos; Pos < Line.size(); ++Pos) {
+        char C = Line[Pos];
+        if (C == '"') {
+            ++Pos;
+            return true;
+        }
+        // JSON strings can't hold raw control characters
+        if ((unsigned char)C < 0x20)
+            return false;
+        if (C != '\\') {
+            Text += C;
+            continue;
+        }
+        if (++Pos >= Line.size())
+            return false;
+        switch (Line[Pos]) {
+        case '"':
+        case '\\':
+        case '/': Text += Line[Pos]; break;
+        case 'b': Text += '\b'; break;
+        case 'f': Text += '\f'; break;
+        case 'n': Text += '\n'; break;
+        case 'r': Text += '\r'; break;
+        case 't': Text += '\t'; break;
+        case 'u': {
+            unsigned long Code;
+            if (!parseHex4(Line, Pos, Code))
+                return false;
+            // Surrogates only come in pairs, combined into one code point
+            if (0xD800 <= Code && Code <= 0xDBFF) {
+                unsigned long Low;
+                if (Pos + 2 >= Line.size() || Line[Pos + 1] != '\\' ||
+                    Line[Pos + 2] != 'u')
+                    return false;
+                Pos += 2;
+                if (!parseHex4(Line, Pos, Low) || Low < 0xDC00 || Low > 0xDFFF)
+                    return false;
+                Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+            } else if (0xDC00 <= Code && Code <= 0xDFFF)
+                return false;
+            // Paths can't hold a NUL byte
+            if (Code == 0)
+                return false;
+
+            // Encodes the code point as UTF-8
+            if (Code < 0x80)
+                Text += (char)Code;
+            else if (Code < 0x800) {
+                Text += (char)(0xC0 | (Code >> 6));
+                Text += (char)(0x80 | (Code & 0x3F));
+            } else if (Code < 0x10000) {
+                Text += (char)(0xE0 | (Code >> 12));
+                Text += (char)(0x80 | ((Code >> 6) & 0x3F));
+                Text += (char)(0x80 | (Code & 0x3F));
+            } else {
+                Text += (char)(0xF0 | (Code >> 18));
+                Text += (char)(0x80 | ((Code >> 12) & 0x3F));
+                Text += (char)(0x80 | ((Code >> 6) & 0x3F));
+                Text += (char)(0x80 | (Code & 0x3F));
+            }
+            break;
+        }
+        default: return false;
+        }
+    }
+    return false;
+}
+
+// Checks a literal against JSON's number grammar:
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool isNumber(const std::string &Text) {
+    size_t Pos = 0;
+    auto digits = [&] {
+        size_t Start = Pos;
+        while (Pos < Text.size() && isdigit((unsigned char)Text[Pos]))
+            ++Pos;
+        return Pos > Start;
+    };
+
+    if (Pos < Text.size() && Text[Pos] == '-')
+        ++Pos;
+    if (Pos < Text.size() && Text[Pos] == '0')
+        ++Pos;
+    else if (!digits())
+        return false;
+    if (Pos < Text.size() && Text[Pos] == '.') {
+        ++Pos;
+        if (!digits())
+            return false;
+    }
+    if (Pos < Text.size() && (Text[Pos] == 'e' || Text[Pos] == 'E')) {
+        ++Pos;
+        if (Pos < Text.size() && (Text[Pos] == '+' || Text[Pos] == '-'))
+            ++Pos;
+        if (!digits())
+            return false;
+    }
+    return Pos == Text.size();
+}
+
+/// Parses a flat JSON object (no nested objects or arrays).
+///
+/// \param Line the JSON text.
+/// \param Fields filled with the object's members.
+///
+/// \returns true on success or false if the line is not a flat object.
+static bool parseObject(const std::string &Line,
+                        std::map<std::string, Value> &Fields) {
+    size_t Pos = 0;
+    skipSpaces(Line, Pos);
+    if (Pos >= Line.size() || Line[Pos++] != '{')
+        return false;
+    skipSpaces(Line, Pos);
+    if (Pos < Line.size() && Line[Pos] == '}')
+        ++Pos;
+    else
+        for (;;) {
+            std::string Key;
+            Value Val{false, ""};
+            skipSpaces(Line, Pos);
+            if (!parseString(Line, Pos, Key))
+                return false;
+            skipSpaces(Line, Pos);
+            if (Pos >= Line.size() || Line[Pos++] != ':')
+                return false;
+            skipSpaces(Line, Pos);
+            if (Pos < Line.size() && Line[Pos] == '"') {
+                Val.IsString = true;
+                if (!parseString(Line, Pos, Val.Text))
+                    return false;
+            } else {
+                while (Pos < Line.size() &&
+                       (isalnum((unsigned char)Line[Pos]) ||
+                        strchr("+-.", Line[Pos])))
+                    Val.Text += Line[Pos++];
+                if (Val.Text != "true" && Val.Text != "false" &&
+                    Val.Text != "null" && !isNumber(Val.Text))
+                    return false;
+            }
+            Fields[Key] = Val;
+            skipSpaces(Line, Pos);
+            if (Pos >= Line.size())
+                return false;
+            if (Line[Pos] == '}') {
+                ++Pos;
+                break;
+            }
+            if (Line[Pos++] != ',')
+                return false;
+        }
+    skipSpaces(Line, Pos);
+    return Pos == Line.size();
+}
+
+// Converts a number that must be an integer in [Min, Max]
+static bool toInteger(const Value &Val, long long Min, long long Max,
+                      long long &Result) {
+    if (Val.IsString)
+        return false;
+    char *End;
+    errno  = 0;
+    Result = strtoll(Val.Text.c_str(), &End, 10);
+    return *End == '\0' && errno != ERANGE && Min <= Result && Result <= Max;
+}
+
+// Converts a number that must be in [Min, Max]
+static bool toFloat(const Value &Val, float Min, float Max, float &Result) {
+    if (Val.IsString)
+        return false;
+    char *End;
+    errno            = 0;
+    double Converted = strtod(Val.Text.c_str(), &End);
+    if (*End != '\0' || errno == ERANGE || !(Min <= Converted) ||
+        !(Converted <= Max))
+        return false;
+    Result = Converted;
+    return true;
+}
+
+static bool toBool(const Value &Val, bool &Result) {
+    if (Val.IsString || (Val.Text != "true" && Val.Text != "false"))
+        return false;
+    Result = Val.Text == "true";
+    return true;
+}
+
+std::shared_ptr<const Problem::Instance>
+InstanceCache::get(const std::string &InstancePath, Problem::Config Config,
+                   bool &Hit, std::string &Error) {
+    struct stat Stat;
+    if (stat(InstancePath.c_str(), &Stat) != 0 || !S_ISREG(Stat.st_mode)) {
+        Error = "unable to open path " + InstancePath;
+        return nullptr;
+    }
+
+    // Edge weights (hence the distance matrix) depend on SetupTimes
+    std::string Key = InstancePath;
+    Key += '\0';
+    Key += Config.SetupTimes ? '1' : '0';
+
+    std::promise<std::shared_ptr<const Problem::Instance>> Loading;
+    std::shared_future<std::shared_ptr<const Problem::Instance>> Instance;
+    uint64_t Generation;
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        auto It = Index.find(Key);
+        if (It != Index.end()) {
+            auto EntryIt = It->second;
+            if (EntryIt->MTime.tv_sec == Stat.st_mtim.tv_sec &&
+                EntryIt->MTime.tv_nsec == Stat.st_mtim.tv_nsec &&
+                EntryIt->FileSize == Stat.st_size) {
+                Entries.splice(Entries.begin(), Entries, EntryIt);
+                Instance = EntryIt->Instance;
+            } else {
+                // The file changed on disk
+                Entries.erase(EntryIt);
+                Index.erase(It);
+            }
+        }
+
+        // Misses publish the load right away, so concurrent misses on the
+        // same key wait for it instead of loading the file again
+        if (!Instance.valid()) {
+            Instance   = Loading.get_future().share();
+            Generation = ++LastGeneration;
+            Entries.push_front(
+                {Key, Stat.st_mtim, Stat.st_size, Generation, Instance});
+            Index[Key] = Entries.begin();
+            while (Entries.size() > Capacity) {
+                Index.erase(Entries.back().Key);
+                Entries.pop_back();
+            }
+            Hit = false;
+        } else
+            Hit = true;
+    }
+
+    // Loads without holding the lock so jobs on other instances aren't held
+    // up by the distance matrix computation
+    if (!Hit) {
+        try {
+            Loading.set_value(std::make_shared<const Problem::Instance>(
+                Problem::loadInstance(InstancePath, Config)));
+        } catch (...) {
+            Loading.set_exception(std::current_exception());
+            // Doesn't keep the failure around, a fixed file loads next time
+            std::lock_guard<std::mutex> Lock(Mutex);
+            auto It = Index.find(Key);
+            if (It != Index.end() && It->second->Generation == Generation) {
+                Entries.erase(It->second);
+                Index.erase(It);
+            }
+        }
+    }
+
+    try {
+        return Instance.get();
+    } catch (const std::runtime_error &E) {
+        Error = E.what();
+        return nullptr;
+    }
+}
+
+std::string Server::errorResult(const std::string &Id,
+                                const std::string &Error) {
+    return "{\"id\":" + Id + ",\"error\":" + quote(Error) + "}\n";
+}
+
+void Server::handleLine(const std::string &Line, std::shared_ptr<Channel> Out) {
+    auto Received = Clock::now();
+    std::map<std::string, Value> Fields;
+    if (!parseObject(Line, Fields)) {
+        Out->send(errorResult("null", "malformed job, expected a JSON object"));
+        return;
+    }
+
+    Job J;
+    J.Id = "null";
+    if (Fields.count("id"))
+        J.Id = Fields["id"].IsString ? quote(Fields["id"].Text)
+                                     : Fields["id"].Text;
+
+    if (!Fields.count("instance") || !Fields["instance"].IsString) {
+        Out->send(errorResult(J.Id, "missing \"instance\" path"));
+        return;
+    }
+    J.InstancePath         = Fields["instance"].Text;
+    J.ProblemConfig        = Config.ProblemConfig;
+    J.PerturbationStrength = Config.PerturbationStrength;
+    J.Evaluations          = Config.Evaluations;
+    J.RandomSeed           = Config.RandomSeed;
+    J.Deadline             = Clock::time_point::max();
+    J.Out                  = Out;
+
+    // The deadline counts from the moment the job is received, so time
+    // spent waiting in the queue is included. It must not overflow.
+    const long long MaxDeadlineMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::time_point::max() - Received)
+            .count();
+    long long Evaluations, Seed, DeadlineMs;
+    bool Valid = true;
+
+    if (Fields.count("evaluations")) {
+        if (toInteger(Fields["evaluations"], LONG_MIN, LONG_MAX, Evaluations))
+            J.Evaluations = Evaluations;
+        else
+            Valid = false;
+    }
+    // Both are documented as [0, 1]. Anything else trips the solver's
+    // assertions or makes the perturbation run away.
+    if (Fields.count("perturbation"))
+        Valid &= toFloat(Fields["perturbation"], 0, 1, J.PerturbationStrength);
+    if (Fields.count("relaxation"))
+        Valid &= toFloat(Fields["relaxation"], 0, 1,
+                         J.ProblemConfig.RelaxationThreshold);
+    if (Fields.count("seed")) {
+        if (toInteger(Fields["seed"], INT_MIN, INT_MAX, Seed))
+            J.RandomSeed = Seed;
+        else
+            Valid = false;
+    }
+    if (Fields.count("setup_times"))
+        Valid &= toBool(Fields["setup_times"], J.ProblemConfig.SetupTimes);
+    if (Fields.count("deadline_ms")) {
+        if (toInteger(Fields["deadline_ms"], 0, MaxDeadlineMs, DeadlineMs))
+            J.Deadline = Received + std::chrono::milliseconds(DeadlineMs);
+        else
+            Valid = false;
+    }
+
+    if (!Valid) {
+        Out->send(errorResult(J.Id, "invalid job parameter"));
+        return;
+    }
+
+    if (!Queue.push(J))
+        Out->send(errorResult(J.Id, "server is shutting down"));
+}
+
+std::string Server::runJob(const Job &J) {
+    auto Start = Clock::now();
+    if (Start >= J.Deadline)
+        return errorResult(J.Id, "deadline exceeded before the job started");
+
+    bool Hit = false;
+    std::string Error;
+    auto Cached = Cache.get(J.InstancePath, J.ProblemConfig, Hit, Error);
+    if (!Cached)
+        return errorResult(J.Id, Error);
+
+    // The relaxation threshold isn't part of the cache key. Jobs asking for
+    // another one work on their own copy.
+    const Problem::Instance *Instance = Cached.get();
+    std::unique_ptr<Problem::Instance> Relaxed;
+    if (Instance->RelaxationThreshold != J.ProblemConfig.RelaxationThreshold) {
+        Relaxed.reset(new Problem::Instance(*Instance));
+        Relaxed->RelaxationThreshold = J.ProblemConfig.RelaxationThreshold;
+        Instance = Relaxed.get();
+    }
+
+    // Same automatic budget as the command line
+    long int Evaluations = J.Evaluations;
+    if (Evaluations <= 0)
+        Evaluations = 10000 * Instance->NumOfNodes;
+
+    ILS::Config ILSConfig = {J.ProblemConfig.RelaxationThreshold,
+                             J.PerturbationStrength, Evaluations,
+                             J.RandomSeed};
+    ILSConfig.Deadline = J.Deadline;
+
+    Problem::Solution Solution = ILS::solveInstance(*Instance, ILSConfig);
+    auto End = Clock::now();
+    auto ElapsedMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(End - Start);
+
+    return "{\"id\":" + J.Id + ",\"instance\":" + quote(J.InstancePath) +
+           ",\"makespan\":" + std::to_string(Solution.GetMakespan()) +
+           ",\"cache_hit\":" + (Hit ? "true" : "false") +
+           ",\"deadline_exceeded\":" + (End >= J.Deadline ? "true" : "false") +
+           ",\"elapsed_ms\":" + std::to_string(ElapsedMs.count()) + "}\n";
+}
+
+void Server::serveConnection(int InFd, std::shared_ptr<Channel> Out) {
+    std::string Buffer;
+    char Chunk[4096];
+    bool Discarding = false;
+
+    for (;;) {
+        auto N = read(InFd, Chunk, sizeof(Chunk));
+        if (N < 0 && errno == EINTR)
+            continue;
+        if (N <= 0)
+            break;
+        Buffer.append(Chunk, N);
+
+        size_t Pos;
+        while ((Pos = Buffer.find('\n')) != std::string::npos) {
+            std::string Line = Buffer.substr(0, Pos);
+            Buffer.erase(0, Pos + 1);
+            if (Discarding) {
+                // Rest of a line that was too long
+                Discarding = false;
+                continue;
+            }
+            if (!Line.empty() && Line.back() == '\r')
+                Line.pop_back();
+            if (Line.find_first_not_of(" \t") != std::string::npos) {
+                Out->acquire();
+                handleLine(Line, Out);
+            }
+        }
+
+        if (Buffer.size() > MaxLineLength) {
+            if (!Discarding) {
+                Out->acquire();
+                Out->send(errorResult("null", "job line too long"));
+            }
+            Discarding = true;
+            Buffer.clear();
+        }
+    }
+
+    if (!Discarding &&
+        Buffer.find_first_not_of(" \t\r") != std::string::npos) {
+        Out->acquire();
+        handleLine(Buffer, Out);
+    }
+    Out->finish();
+}
+
+static size_t workersOrDefault(size_t Workers) {
+    if (Workers > 0)
+        return Workers;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+int Service::serveStream(int InFd, int OutFd, Service::Config Config) {
+    signal(SIGPIPE, SIG_IGN);
+    Config.Workers = workersOrDefault(Config.Workers);
+
+    Server S(Config);
+    if (!S.start())
+        return -1;
+    S.serveConnection(InFd, std::make_shared<Channel>(OutFd, false));
+    S.stop();
+    return 0;
+}
+
+static bool socketAddress(const std::string &SocketPath, sockaddr_un &Addr) {
+    memset(&Addr, 0, sizeof(Addr));
+    Addr.sun_family = AF_UNIX;
+    if (SocketPath.size() >= sizeof(Addr.sun_path)) {
+        std::cerr << "error: socket path too long " << SocketPath << "\n";
+        return false;
+    }
+    strcpy(Addr.sun_path, SocketPath.c_str());
+    return true;
+}
+
+static volatile sig_atomic_t StopRequested = 0;
+static int ListeningFd                     = -1;
+
+static void stopListening(int) {
+    StopRequested = 1;
+    // Async-signal-safe, and unblocks accept whichever thread got the signal
+    shutdown(ListeningFd, SHUT_RDWR);
+}
+
+int Service::serveSocket(const std::string &SocketPath,
+                         Service::Config Config) {
+    signal(SIGPIPE, SIG_IGN);
+    Config.Workers = workersOrDefault(Config.Workers);
+
+    sockaddr_un Addr;
+    if (!socketAddress(SocketPath, Addr))
+        return -1;
+
+    int ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ListenFd < 0) {
+        perror("error: socket");
+        return -1;
+    }
+    // Only replaces a socket left behind by a previous run
+    struct stat Stat;
+    if (lstat(SocketPath.c_str(), &Stat) == 0) {
+        if (!S_ISSOCK(Stat.st_mode)) {
+            std::cerr << "error: " << SocketPath
+                      << " exists and is not a socket\n";
+            close(ListenFd);
+            return -1;
+        }
+        unlink(SocketPath.c_str());
+    }
+    if (bind(ListenFd, (sockaddr *)&Addr, sizeof(Addr)) != 0 ||
+        listen(ListenFd, SOMAXCONN) != 0) {
+        perror(("error: unable to listen on " + SocketPath).c_str());
+        close(ListenFd);
+        return -1;
+    }
+
+    // The first SIGINT or SIGTERM wakes accept up, a second one kills the
+    // process right away
+    ListeningFd = ListenFd;
+    struct sigaction Action;
+    memset(&Action, 0, sizeof(Action));
+    Action.sa_handler = stopListening;
+    Action.sa_flags   = SA_RESETHAND;
+    sigemptyset(&Action.sa_mask);
+    sigaction(SIGINT, &Action, nullptr);
+    sigaction(SIGTERM, &Action, nullptr);
+
+    // Shared with the connection threads, which may outlive this function
+    auto S = std::make_shared<Server>(Config);
+    if (!S->start()) {
+        close(ListenFd);
+        unlink(SocketPath.c_str());
+        return -1;
+    }
+
+    int Status = 0;
+    while (!StopRequested) {
+        int Fd = accept(ListenFd, nullptr, nullptr);
+        if (Fd < 0) {
+            if (StopRequested)
+                break;
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("error: accept");
+            Status = -1;
+            break;
+        }
+        auto Out = std::make_shared<Channel>(Fd, true);
+        std::thread([S, Fd, Out] {
+            S->serveConnection(Fd, Out);
+            shutdown(Fd, SHUT_RD);
+        }).detach();
+    }
+
+    close(ListenFd);
+    unlink(SocketPath.c_str());
+    S->stop();
+    return Status;
+}
+
+int Service::runClient(const std::string &SocketPath) {
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un Addr;
+    if (!socketAddress(SocketPath, Addr))
+        return -1;
+
+    int Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (Fd < 0 || connect(Fd, (sockaddr *)&Addr, sizeof(Addr)) != 0) {
+        perror(("error: unable to connect to " + SocketPath).c_str());
+        if (Fd >= 0)
+            close(Fd);
+        return -1;
+    }
+
+    auto copy = [](int From, int To) {
+        char Chunk[4096];
+        for (;;) {
+            auto N = read(From, Chunk, sizeof(Chunk));
+            if (N < 0 && errno == EINTR)
+                continue;
+            if (N <= 0)
+                return;
+            for (ssize_t Sent = 0; Sent < N;) {
+                auto M = write(To, Chunk + Sent, N - Sent);
+                if (M < 0 && errno == EINTR)
+                    continue;
+                if (M <= 0)
+                    return;
+                Sent += M;
+            }
+        }
+    };
+
+    // Sends every job, then tells the server there won't be more. It closes
+    // the connection after the last result.
+    std::thread Sender([&] {
+        copy(STDIN_FILENO, Fd);
+        shutdown(Fd, SHUT_WR);
+    });
+    copy(Fd, STDOUT_FILENO);
+
+    Sender.join();
+    close(Fd);
+    return 0;
+}
@@ -0,0 +1,98 @@
+#ifndef SERVICE_H
+#define SERVICE_H
+
+#include <cstdint>
+#include <ctime>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "problem.h"
+
+namespace Service {
+
+// Defaults for every job plus the server's own settings
+struct Config {
+    Problem::Config ProblemConfig;
+    float PerturbationStrength;
+    long int Evaluations;
+    int RandomSeed;
+    size_t Workers;
+    size_t CacheSize;
+};
+
+/// Keeps the most recently used instances (and their distance matrices)
+/// in memory. An entry is reloaded when the file's mtime or size changes.
+/// Safe to share between threads.
+class InstanceCache {
+  public:
+    explicit InstanceCache(size_t _Capacity) : Capacity{_Capacity} {}
+
+    /// Gets an instance, loading it on a miss.
+    ///
+    /// \param InstancePath the path of the instance to load.
+    /// \param Config the problem config used on a miss. Only SetupTimes is
+    ///        part of the key, RelaxationThreshold is left to the caller.
+    /// \param Hit set to true if the instance was cached or already being
+    ///        loaded by another job.
+    /// \param Error set to a message when the file can't be read or is
+    ///        not a valid instance.
+    ///
+    /// \returns the instance, or nullptr on error.
+    std::shared_ptr<const Problem::Instance> get(const std::string &InstancePath,
+                                                 Problem::Config Config,
+                                                 bool &Hit, std::string &Error);
+
+  private:
+    struct Entry {
+        std::string Key;
+        timespec MTime;
+        off_t FileSize;
+        // Tells a reloaded entry apart from the one being replaced
+        uint64_t Generation;
+        // Ready once loaded. Jobs missing at the same time share one load.
+        std::shared_future<std::shared_ptr<const Problem::Instance>> Instance;
+    };
+
+    size_t Capacity;
+    uint64_t LastGeneration{0};
+    std::mutex Mutex;
+    // Most recently used first
+    std::list<Entry> Entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> Index;
+};
+
+/// Reads JSON-lines jobs from InFd and writes one JSON result per job to
+/// OutFd, in completion order. Returns once InFd is closed and every job
+/// has finished.
+///
+/// Typical usage:
+/// \code
+///   Service::serveStream(STDIN_FILENO, STDOUT_FILENO, Config);
+/// \endcode
+///
+/// \returns 0 on success or -1 on error.
+int serveStream(int InFd, int OutFd, Config Config);
+
+/// Listens on a Unix domain socket and serves every connection as a
+/// JSON-lines stream. All connections share one worker pool and one
+/// instance cache. Runs until SIGINT or SIGTERM, then finishes the queued
+/// jobs and removes the socket.
+///
+/// \param SocketPath the filesystem path to bind. A stale socket there is
+///        replaced, any other kind of file is left alone.
+///
+/// \returns 0 after a signal or -1 on error.
+int serveSocket(const std::string &SocketPath, Config Config);
+
+/// Local client: sends stdin to the server at SocketPath and copies every
+/// result to stdout until the server has answered all jobs.
+///
+/// \returns 0 on success or -1 on error.
+int runClient(const std::string &SocketPath);
+
+} // namespace Service
+#endif